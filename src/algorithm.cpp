@@ -1,5 +1,8 @@
 #include "algorithm.h"
+#include "sort_kernels.h"
+#include "trace.h"
 #include <iostream>
+#include <algorithm>
 #include <omp.h> // 必须引入 OpenMP 头文件
 
 // === 数据初始化 ===
@@ -14,6 +17,7 @@ void init_data(float* data, int len, int offset) {
 // 基础版本 - 无加速
 
 float sum(const float data[], const int len) {
+    TraceSpan span("sum", len);
     float total = 0.0f;
     for (int i = 0; i < len; ++i) {
         total += transform(data[i]);
@@ -22,6 +26,7 @@ float sum(const float data[], const int len) {
 }
 
 float max(const float data[], const int len) {
+    TraceSpan span("max", len);
     if (len == 0) return 0.0f;
     float max_val = transform(data[0]);
     for (int i = 1; i < len; ++i) {
@@ -33,50 +38,24 @@ float max(const float data[], const int len) {
     return max_val;
 }
 
-// 归并排序辅助函数：合并两个有序区间
-static void merge(float* arr, int l, int m, int r, float* temp) {
-    int i = l;
-    int j = m + 1;
-    int k = 0;
-
-    while (i <= m && j <= r) {
-        if (transform(arr[i]) <= transform(arr[j])) {
-            temp[k++] = arr[i++];
-        } else {
-            temp[k++] = arr[j++];
-        }
-    }
-    while (i <= m) temp[k++] = arr[i++];
-    while (j <= r) temp[k++] = arr[j++];
-
-    for (i = 0; i < k; ++i) {
-        arr[l + i] = temp[i];
-    }
-}
-
-// 基础版递归
-static void merge_sort_recursive(float* arr, int l, int r, float* temp) {
-    if (l < r) {
-        int m = l + (r - l) / 2;
-        merge_sort_recursive(arr, l, m, temp);
-        merge_sort_recursive(arr, m + 1, r, temp);
-        merge(arr, l, m, r, temp);
-    }
-}
-
 float sort(const float data[], const int len, float result[]) {
-    // 1. 拷贝
-    for (int i = 0; i < len; ++i) result[i] = data[i];
-    
-    // 2. 排序
+    TraceSpan span("sort", len);
     try {
-        std::vector<float> temp(len);
-        merge_sort_recursive(result, 0, len - 1, temp.data());
+        // 1. 预计算排序键（每个元素只做一次 transform）
+        std::vector<int64_t> keys(len);
+        std::vector<int64_t> temp(len);
+        for (int i = 0; i < len; ++i) keys[i] = make_sort_key(data[i]);
+
+        // 2. 排序（向量化排序网络 + 双调归并）
+        sort_keys(keys.data(), temp.data(), len);
+
+        // 3. 还原
+        for (int i = 0; i < len; ++i) result[i] = sort_key_value(keys[i]);
     } catch (const std::bad_alloc& e) {
-        std::cerr << "[Algorithm] sort: memory allocation failed for temp: " << e.what() << std::endl;
+        std::cerr << "[Algorithm] sort: memory allocation failed for keys: " << e.what() << std::endl;
         exit(1);
     }
-    
+
     return 0.0f;
 }
 
@@ -84,25 +63,37 @@ float sort(const float data[], const int len, float result[]) {
 
 // 加速版求和
 float sumSpeedUp(const float data[], const int len) {
+    TraceSpan span("sumSpeedUp", len);
     float total = 0.0f;
     // reduction(+:total) 让每个线程有自己的 total，最后加起来
-    #pragma omp parallel for reduction(+:total)
-    for (int i = 0; i < len; ++i) {
-        total += transform(data[i]);
+    #pragma omp parallel reduction(+:total)
+    {
+        // 每个线程记录自己那一段的耗时，便于发现拖尾线程；nowait 去掉 for 末尾的隐式屏障，
+        // 否则快线程的 span 会一直延伸到最慢线程结束（归约在 parallel 区域末尾完成，不受影响）
+        TraceSpan chunk("sumSpeedUp chunk");
+        #pragma omp for nowait
+        for (int i = 0; i < len; ++i) {
+            total += transform(data[i]);
+        }
     }
     return total;
 }
 
 // 加速版最大值
 float maxSpeedUp(const float data[], const int len) {
+    TraceSpan span("maxSpeedUp", len);
     if (len == 0) return 0.0f;
     float max_val = -1e9f; // 初始极小值
 
     // reduction(max:max_val) OpenMP 3.1+ 支持直接求 max
-    #pragma omp parallel for reduction(max:max_val)
-    for (int i = 0; i < len; ++i) {
-        float val = transform(data[i]);
-        if (val > max_val) max_val = val;
+    #pragma omp parallel reduction(max:max_val)
+    {
+        TraceSpan chunk("maxSpeedUp chunk");
+        #pragma omp for nowait
+        for (int i = 0; i < len; ++i) {
+            float val = transform(data[i]);
+            if (val > max_val) max_val = val;
+        }
     }
     return max_val;
 }
@@ -111,40 +102,43 @@ float maxSpeedUp(const float data[], const int len) {
 
 const int PARALLEL_THRESHOLD = 32768; // 阈值：任务太小就不分线程了
 
-static void merge_sort_parallel(float* arr, int l, int r, float* temp) {
+static void merge_sort_parallel(int64_t* keys, int l, int r, int64_t* temp) {
     if (l < r) {
-        // 如果数据量小，直接用单线程递归，避免创建任务的开销
+        // 如果数据量小，直接交给单线程排序内核，避免创建任务的开销
         if (r - l < PARALLEL_THRESHOLD) {
-            merge_sort_recursive(arr, l, r, temp);
+            TraceSpan leaf("sort leaf", r - l + 1);
+            sort_keys(keys + l, temp + l, r - l + 1);
             return;
         }
 
         int m = l + (r - l) / 2;
 
         // 创建两个任务，分别处理左右两边
-        #pragma omp task shared(arr)
-        merge_sort_parallel(arr, l, m, temp);
+        #pragma omp task shared(keys)
+        merge_sort_parallel(keys, l, m, temp);
 
-        #pragma omp task shared(arr)
-        merge_sort_parallel(arr, m + 1, r, temp);
+        #pragma omp task shared(keys)
+        merge_sort_parallel(keys, m + 1, r, temp);
 
         // 等待两个子任务完成
         #pragma omp taskwait
 
-        // 为本次合并分配本地临时缓冲，避免多个任务并发写入同一 temp（竞态）
-        int merge_len = r - l + 1;
-        std::vector<float> local_temp(merge_len);
-        merge(arr, l, m, r, local_temp.data());
+        // 各任务只使用 temp 中与自己区间对应的部分，互不重叠，无需额外分配
+        TraceSpan merge("sort merge", r - l + 1);
+        merge_keys(keys + l, m - l + 1, keys + m + 1, r - m, temp + l);
+        std::copy(temp + l, temp + r + 1, keys + l);
     }
 }
 
 float sortSpeedUp(const float data[], const int len, float result[]) {
-    // 1. 并行拷贝
-    #pragma omp parallel for
-    for (int i = 0; i < len; ++i) result[i] = data[i];
-
+    TraceSpan span("sortSpeedUp", len);
     try {
-        std::vector<float> temp(len);
+        std::vector<int64_t> keys(len);
+        std::vector<int64_t> temp(len);
+
+        // 1. 并行预计算排序键
+        #pragma omp parallel for
+        for (int i = 0; i < len; ++i) keys[i] = make_sort_key(data[i]);
 
         // 2. 启动并行区域
         #pragma omp parallel
@@ -152,12 +146,16 @@ float sortSpeedUp(const float data[], const int len, float result[]) {
             // 只有主线程开始第一个任务，后续任务由递归产生
             #pragma omp single
             {
-                merge_sort_parallel(result, 0, len - 1, temp.data());
+                merge_sort_parallel(keys.data(), 0, len - 1, temp.data());
             }
         }
+
+        // 3. 并行还原
+        #pragma omp parallel for
+        for (int i = 0; i < len; ++i) result[i] = sort_key_value(keys[i]);
     } catch (const std::bad_alloc& e) {
-        std::cerr << "[Algorithm] sortSpeedUp: memory allocation failed for temp: " << e.what() << std::endl;
+        std::cerr << "[Algorithm] sortSpeedUp: memory allocation failed for keys: " << e.what() << std::endl;
         exit(1);
     }
     return 0.0f;
-}
\ No newline at end of file
+}
@@ -17,6 +17,13 @@
 #define CMD_MAX_SPEEDUP 5
 #define CMD_SORT_SPEEDUP 6
 
+// 追踪命令：时钟偏移握手（同时开启 Worker 记录）、导出 Worker 的 span
+#define CMD_CLOCK_SYNC 97
+#define CMD_TRACE_DUMP 98
+
+// 静默命令：Worker 关闭逐条命令日志与传输输出（查询服务模式启动时发送，无回复）
+#define CMD_QUIET 96
+
 #define CMD_READY 99
 
 // 核心变换函数transform
@@ -0,0 +1,56 @@
+#include "histogram.h"
+#include <algorithm>
+
+// 前 2048 个值逐一精确计数；之后每个 [2^n, 2^(n+1)) 区间线性切成 1024 个桶
+static const int SUB_BUCKET_BITS = 11;
+static const uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;   // 2048
+static const uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;        // 1024
+static const int MAX_SHIFT = 30;                                     // 可表示上限约 2^41
+static const uint64_t MAX_VALUE = (SUB_BUCKET_COUNT << MAX_SHIFT) - 1;
+
+static inline int bucket_index(uint64_t v) {
+    if (v < SUB_BUCKET_COUNT) return (int)v;
+    int shift = (63 - __builtin_clzll(v)) - (SUB_BUCKET_BITS - 1);
+    return (int)((shift + 1) * SUB_BUCKET_HALF + ((v >> shift) - SUB_BUCKET_HALF));
+}
+
+// 桶内所有值的最大等价值（HDR 的 highest equivalent value）
+static inline uint64_t bucket_upper(int idx) {
+    if ((uint64_t)idx < SUB_BUCKET_COUNT) return (uint64_t)idx;
+    int shift = idx / (int)SUB_BUCKET_HALF - 1;
+    uint64_t sub = idx % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+    return ((sub + 1) << shift) - 1;
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts_((MAX_SHIFT + 2) * SUB_BUCKET_HALF, 0), total_(0), min_(UINT64_MAX), max_(0), sum_(0) {}
+
+void LatencyHistogram::record(uint64_t value) {
+    if (value > MAX_VALUE) value = MAX_VALUE;
+    ++counts_[bucket_index(value)];
+    ++total_;
+    sum_ += value;
+    if (value < min_) min_ = value;
+    if (value > max_) max_ = value;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (total_ == 0) return 0;
+    q = std::min(std::max(q, 0.0), 100.0);
+    // 至少要覆盖 1 个样本，否则 p0 没有意义
+    uint64_t target = std::max<uint64_t>((uint64_t)(q / 100.0 * (double)total_ + 0.5), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= target) return std::min(bucket_upper((int)i), max_);
+    }
+    return max_;
+}
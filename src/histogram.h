@@ -0,0 +1,36 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+// === HDR 风格延迟直方图 ===
+// 对数-线性分桶：每个 2 的幂区间再线性切成 1024 份，记录值的相对误差 < 0.1%（3 位有效数字）
+// 记录为 O(1) 且不分配内存，适合在压测热路径中逐条记录；单位由调用方决定（这里用微秒）
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    // 记录一个值；超过可表示上限的值按上限计入
+    void record(uint64_t value);
+
+    // 合并另一个直方图的计数
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? (double)sum_ / (double)total_ : 0.0; }
+
+    // 返回第 q 百分位（0 < q <= 100）所在桶的上界
+    uint64_t percentile(double q) const;
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t min_;
+    uint64_t max_;
+    uint64_t sum_;
+};
+
+#endif
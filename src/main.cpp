@@ -6,31 +6,39 @@
 #include <iomanip>
 #include "algorithm.h"
 #include "network.h"
+#include "sort_kernels.h"
+#include "service.h"
+#include "trace.h"
 
 // 可配置的本地数据长度（默认为全局一半），可通过命令行 --small 启用较小调试值
 int g_local_len = DATANUM / 2;
 
+// 追踪输出路径，非空时 master 记录双端时间线并写出 Chrome trace JSON，可通过 --trace=FILE 指定
+std::string g_trace_path;
+
+// 并行数据连接数，<= 0 表示按网卡队列数自动选择，可通过 --streams=N 指定
+int g_streams = 0;
+
 // 计时辅助
 double get_elapsed_ms(struct timespec start, struct timespec end) {
     return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
 }
 
-// 最终归并 (用于 Master 合并结果)
+// 最终归并 (用于 Master 合并结果)，使用排序内核的分块向量化归并
 void final_merge(const float* partA, int lenA, const float* partB, int lenB, float* result) {
-    int i = 0, j = 0, k = 0;
-    while (i < lenA && j < lenB) {
-        if (transform(partA[i]) <= transform(partB[j])) {
-            result[k++] = partA[i++];
-        } else {
-            result[k++] = partB[j++];
-        }
-    }
-    while (i < lenA) result[k++] = partA[i++];
-    while (j < lenB) result[k++] = partB[j++];
+    TraceSpan span("final_merge", lenA + lenB);
+    merge_by_transform(partA, lenA, partB, lenB, result);
 }
 
 // Worker逻辑
 
+// 逐条命令的进度日志；收到 CMD_QUIET 后关闭，避免终端输出混进查询服务的延迟测量
+static bool g_worker_log = true;
+
+static void worker_log(const char* msg) {
+    if (g_worker_log) std::cout << msg << std::endl;
+}
+
 void run_worker(int port) {
     int sock = start_server(port);
 
@@ -48,42 +56,59 @@ void run_worker(int port) {
         
         // 基础版命令
         if (cmd == CMD_SUM) {
-            std::cout << "[Worker] CMD_SUM -> Processing..." << std::endl;
+            TraceSpan span("worker CMD_SUM");
+            worker_log("[Worker] CMD_SUM -> Processing...");
             float s = sum(local_data.data(), half_len);
             send_float(sock, s);
         } 
         else if (cmd == CMD_MAX) {
-            std::cout << "[Worker] CMD_MAX -> Processing..." << std::endl;
+            TraceSpan span("worker CMD_MAX");
+            worker_log("[Worker] CMD_MAX -> Processing...");
             float m = max(local_data.data(), half_len);
             send_float(sock, m);
         } 
         else if (cmd == CMD_SORT) {
-            std::cout << "[Worker] CMD_SORT -> Processing..." << std::endl;
+            TraceSpan span("worker CMD_SORT");
+            worker_log("[Worker] CMD_SORT -> Processing...");
             std::vector<float> sorted_data(half_len);
             sort(local_data.data(), half_len, sorted_data.data());
-            std::cout << "[Worker] Sending data..." << std::endl;
+            worker_log("[Worker] Sending data...");
             send_data(sock, sorted_data.data(), half_len);
-            std::cout << "[Worker] Done." << std::endl;
+            worker_log("[Worker] Done.");
             // 注意：这里删除了 break，让 Worker 继续服务
         }
         // === 加速版命令 ===
         else if (cmd == CMD_SUM_SPEEDUP) {
-            std::cout << "[Worker] CMD_SUM_SPEEDUP -> Processing..." << std::endl;
+            TraceSpan span("worker CMD_SUM_SPEEDUP");
+            worker_log("[Worker] CMD_SUM_SPEEDUP -> Processing...");
             float s = sumSpeedUp(local_data.data(), half_len);
             send_float(sock, s);
         }
         else if (cmd == CMD_MAX_SPEEDUP) {
-            std::cout << "[Worker] CMD_MAX_SPEEDUP -> Processing..." << std::endl;
+            TraceSpan span("worker CMD_MAX_SPEEDUP");
+            worker_log("[Worker] CMD_MAX_SPEEDUP -> Processing...");
             float m = maxSpeedUp(local_data.data(), half_len);
             send_float(sock, m);
         }
         else if (cmd == CMD_SORT_SPEEDUP) {
-            std::cout << "[Worker] CMD_SORT_SPEEDUP -> Processing..." << std::endl;
+            TraceSpan span("worker CMD_SORT_SPEEDUP");
+            worker_log("[Worker] CMD_SORT_SPEEDUP -> Processing...");
             std::vector<float> sorted_data(half_len);
             sortSpeedUp(local_data.data(), half_len, sorted_data.data()); // 调用加速版
-            std::cout << "[Worker] Sending data..." << std::endl;
+            worker_log("[Worker] Sending data...");
             send_data(sock, sorted_data.data(), half_len);
-            std::cout << "[Worker] Done." << std::endl;
+            worker_log("[Worker] Done.");
+        }
+        // === 追踪命令 ===
+        else if (cmd == CMD_CLOCK_SYNC) {
+            trace_serve_clock_sync(sock);
+        }
+        else if (cmd == CMD_TRACE_DUMP) {
+            trace_serve_dump(sock);
+        }
+        else if (cmd == CMD_QUIET) {
+            g_worker_log = false;
+            set_transfer_log(false);
         }
     }
     close_socket(sock);
@@ -98,7 +123,8 @@ void run_master(std::string ip, int port) {
     std::vector<float> local_data(half_len);
     init_data(local_data.data(), half_len, 0);
 
-    int sock = connect_to_worker(ip, port);
+    int sock = connect_to_worker(ip, port, g_streams);
+    if (!g_trace_path.empty()) trace_start_session(sock);
     
     // 变量定义
     double t_basic_sum, t_speed_sum;
@@ -127,6 +153,7 @@ void run_master(std::string ip, int port) {
     float total_s = s1 + s2;
     clock_gettime(CLOCK_MONOTONIC, &end);
     t_basic_sum = get_elapsed_ms(start, end);
+    trace_record("master SUM", trace_ns(start), trace_ns(end));
     std::cout << "Time: " << t_basic_sum << " ms | Result: " << total_s << std::endl;
 
     // 2. MAX
@@ -138,6 +165,7 @@ void run_master(std::string ip, int port) {
     float total_m = (m1 > m2) ? m1 : m2;
     clock_gettime(CLOCK_MONOTONIC, &end);
     t_basic_max = get_elapsed_ms(start, end);
+    trace_record("master MAX", trace_ns(start), trace_ns(end));
     std::cout << "Time: " << t_basic_max << " ms | Result: " << total_m << std::endl;
 
     // 3. SORT
@@ -149,6 +177,7 @@ void run_master(std::string ip, int port) {
     final_merge(local_sorted.data(), half_len, remote_sorted.data(), half_len, final_res.data());
     clock_gettime(CLOCK_MONOTONIC, &end);
     t_basic_sort = get_elapsed_ms(start, end);
+    trace_record("master SORT", trace_ns(start), trace_ns(end));
     std::cout << "Time: " << t_basic_sort << " ms" << std::endl;
 
 
@@ -168,6 +197,7 @@ void run_master(std::string ip, int port) {
     float f_total_s = fs1 + fs2;
     clock_gettime(CLOCK_MONOTONIC, &end);
     t_speed_sum = get_elapsed_ms(start, end);
+    trace_record("master SUM_SPEEDUP", trace_ns(start), trace_ns(end));
     std::cout << "Time: " << t_speed_sum << " ms | Result: " << f_total_s << std::endl;
 
     // 2. MAX SpeedUp
@@ -179,6 +209,7 @@ void run_master(std::string ip, int port) {
     float f_total_m = (fm1 > fm2) ? fm1 : fm2;
     clock_gettime(CLOCK_MONOTONIC, &end);
     t_speed_max = get_elapsed_ms(start, end);
+    trace_record("master MAX_SPEEDUP", trace_ns(start), trace_ns(end));
     std::cout << "Time: " << t_speed_max << " ms | Result: " << f_total_m << std::endl;
 
     // 3. SORT SpeedUp
@@ -190,6 +221,7 @@ void run_master(std::string ip, int port) {
     final_merge(local_sorted.data(), half_len, remote_sorted.data(), half_len, final_res.data());
     clock_gettime(CLOCK_MONOTONIC, &end);
     t_speed_sort = get_elapsed_ms(start, end);
+    trace_record("master SORT_SPEEDUP", trace_ns(start), trace_ns(end));
     std::cout << "Time: " << t_speed_sort << " ms" << std::endl;
 
     // ============================================
@@ -206,6 +238,9 @@ void run_master(std::string ip, int port) {
     double all_sum = t_basic_sum + t_basic_max + t_basic_sort;
     double speed_sum = t_speed_sum + t_speed_max + t_speed_sort;
     std::cout << "TOTAL   | " << std::setw(10) << all_sum << " | " << std::setw(12) << speed_sum << " | " << std::fixed << std::setprecision(2) << all_sum / speed_sum << "x" << std::endl;
+
+    // 拉取 Worker 的 span 并写出合并后的时间线
+    if (!g_trace_path.empty()) trace_finish_session(sock, g_trace_path);
     close_socket(sock);
 }
 
@@ -213,15 +248,20 @@ int main(int argc, char* argv[]) {
     std::string mode = "master";
     std::string ip = "127.0.0.1";
     int port = 8080;
+    std::string spec_path;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--worker") == 0) mode = "worker";
         else if (strncmp(argv[i], "--ip=", 5) == 0) ip = argv[i] + 5;
         else if (strncmp(argv[i], "--port=", 7) == 0) port = std::atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--serve=", 8) == 0) { mode = "service"; spec_path = argv[i] + 8; }
+        else if (strncmp(argv[i], "--trace=", 8) == 0) g_trace_path = argv[i] + 8;
+        else if (strncmp(argv[i], "--streams=", 10) == 0) g_streams = std::atoi(argv[i] + 10);
         else if (strcmp(argv[i], "--small") == 0) g_local_len = 16384; // 方便调试的小规模模式
     }
 
     if (mode == "worker") run_worker(port);
+    else if (mode == "service") run_service(ip, port, spec_path);
     else run_master(ip, port);
 
     return 0;
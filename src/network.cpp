@@ -1,16 +1,23 @@
 #include "network.h"
+#include "uring.h"
+#include "trace.h"
 #include <iostream>
 #include <cstring>
+#include <cstdint>
 #include <unistd.h>     // close
 #include <sys/socket.h> // socket, bind, listen...
 #include <arpa/inet.h>  // inet_addr
 #include <netinet/in.h>
 #include <errno.h>
+#include <poll.h>
+#include <ifaddrs.h>
+#include <dirent.h>
 #include <chrono>
 #include <thread>
 #include <algorithm>
 #include <vector>
-#include <vector>
+#include <map>
+#include <memory>
 
 // 辅助宏：检查 Socket 错误
 void check_error(int res, const char* msg) {
@@ -20,6 +27,29 @@ void check_error(int res, const char* msg) {
     }
 }
 
+// socket 收发超时（秒），同时作为 poll()/io_uring 等待的上限
+static const int SOCKET_TIMEOUT_SEC = 30;
+
+// 单次提交的最大字节数，也是进度条的刷新粒度
+static const size_t IO_CHUNK = 1024 * 1024; // 1MB
+
+// send_data/recv_data 是否打印进度条与带宽
+static bool g_transfer_log = true;
+
+void set_transfer_log(bool enabled) {
+    g_transfer_log = enabled;
+}
+
+// 每个条带至少承载的字节数，避免小数组也被拆到多条连接上
+static const size_t MIN_STRIPE_BYTES = 1024 * 1024; // 1MB
+
+// 每个控制连接对应的数据连接与 io_uring 实例
+struct StripeSet {
+    std::vector<int> fds;
+    IoRing ring;
+};
+static std::map<int, std::unique_ptr<StripeSet>> g_stripe_sets;
+
 // 配置 socket 超时（秒）并调整缓冲区
 static void set_socket_timeout_and_buffers(int fd, int seconds) {
     struct timeval tv;
@@ -33,13 +63,25 @@ static void set_socket_timeout_and_buffers(int fd, int seconds) {
     setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
 }
 
+// 等待 fd 可读/可写，超时视为连接异常
+static void wait_fd(int fd, short events, const char* msg) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    int ret;
+    do {
+        ret = poll(&pfd, 1, SOCKET_TIMEOUT_SEC * 1000);
+    } while (ret < 0 && errno == EINTR);
+    if (ret == 0) errno = ETIMEDOUT;
+    if (ret <= 0) check_error(-1, msg);
+}
+
 // 循环发送，确保字节已发送
 void send_all(int fd, const void* buffer, size_t length) {
     const char* ptr = static_cast<const char*>(buffer);
     size_t remaining = length;
     const size_t CHUNK = 1024 * 1024; // 1MB 分块
-    int retry_count = 0;
-    const int MAX_RETRY = 100;
     while (remaining > 0) {
         size_t to_send = std::min(remaining, CHUNK);
 #ifdef MSG_NOSIGNAL
@@ -49,20 +91,18 @@ void send_all(int fd, const void* buffer, size_t length) {
 #endif
         if (sent < 0) {
             if (errno == EINTR) continue;
+            // 缓冲区满时等待可写，而不是固定休眠
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                if (++retry_count > MAX_RETRY) check_error(-1, "Send failed (EAGAIN)");
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                wait_fd(fd, POLLOUT, "Send failed (EAGAIN)");
                 continue;
             }
             check_error(-1, "Send failed");
         } else if (sent == 0) {
-            if (++retry_count > MAX_RETRY) check_error(-1, "Send failed (sent 0)");
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            wait_fd(fd, POLLOUT, "Send failed (sent 0)");
             continue;
         }
         ptr += sent;
         remaining -= sent;
-        retry_count = 0;
     }
 }
 
@@ -71,16 +111,13 @@ void recv_all(int fd, void* buffer, size_t length) {
     char* ptr = static_cast<char*>(buffer);
     size_t remaining = length;
     const size_t CHUNK = 64 * 1024;
-    int retry_count = 0;
-    const int MAX_RETRY = 100;
     while (remaining > 0) {
         size_t to_recv = std::min(remaining, CHUNK);
         ssize_t received = recv(fd, ptr, to_recv, 0);
         if (received < 0) {
             if (errno == EINTR) continue;
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                if (++retry_count > MAX_RETRY) check_error(-1, "Recv failed (EAGAIN)");
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                wait_fd(fd, POLLIN, "Recv failed (EAGAIN)");
                 continue;
             }
             check_error(-1, "Recv failed (Connection closed?)");
@@ -89,10 +126,62 @@ void recv_all(int fd, void* buffer, size_t length) {
         }
         ptr += received;
         remaining -= received;
-        retry_count = 0;
     }
 }
 
+// 为控制连接创建条带集合，并初始化 io_uring（不可用时回退到 poll）
+static StripeSet& attach_stripes(int ctrl_fd, const std::vector<int>& fds) {
+    std::unique_ptr<StripeSet> set(new StripeSet());
+    set->fds = fds;
+    // 每条流同一时刻只有一个请求在途，预留一倍余量
+    if (!set->ring.init(2 * MAX_STREAMS, {IORING_OP_SEND, IORING_OP_RECV})) {
+        std::cerr << "[Network] io_uring unavailable (" << strerror(errno) << "), falling back to poll()" << std::endl;
+    }
+    StripeSet& ref = *set;
+    g_stripe_sets[ctrl_fd] = std::move(set);
+    return ref;
+}
+
+static StripeSet& stripes_of(int ctrl_fd) {
+    auto it = g_stripe_sets.find(ctrl_fd);
+    if (it == g_stripe_sets.end()) {
+        std::cerr << "[Network] no data streams attached to fd=" << ctrl_fd << std::endl;
+        exit(1);
+    }
+    return *it->second;
+}
+
+// 统计本地出口网卡的接收队列数（/sys/class/net/<if>/queues/rx-*），作为默认条带数
+static int detect_nic_queues(int sock) {
+    struct sockaddr_in local;
+    socklen_t slen = sizeof(local);
+    if (getsockname(sock, (struct sockaddr*)&local, &slen) < 0) return 1;
+
+    std::string ifname;
+    struct ifaddrs* ifs = nullptr;
+    if (getifaddrs(&ifs) < 0) return 1;
+    for (struct ifaddrs* ifa = ifs; ifa; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_INET) continue;
+        const struct sockaddr_in* a = (const struct sockaddr_in*)ifa->ifa_addr;
+        if (a->sin_addr.s_addr == local.sin_addr.s_addr) {
+            ifname = ifa->ifa_name;
+            break;
+        }
+    }
+    freeifaddrs(ifs);
+    if (ifname.empty()) return 1;
+
+    std::string path = "/sys/class/net/" + ifname + "/queues";
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return 1;
+    int queues = 0;
+    while (struct dirent* ent = readdir(dir)) {
+        if (strncmp(ent->d_name, "rx-", 3) == 0) ++queues;
+    }
+    closedir(dir);
+    return std::max(queues, 1);
+}
+
 // 1. Worker: 启动服务器
 int start_server(int port) {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -108,7 +197,8 @@ int start_server(int port) {
     address.sin_port = htons(port);       // 端口号转网络字节序
 
     check_error(bind(server_fd, (struct sockaddr*)&address, sizeof(address)), "Bind failed");
-    check_error(listen(server_fd, 1), "Listen failed"); // 只允许 1 个连接
+    // 1 个控制连接 + 最多 MAX_STREAMS 个数据连接
+    check_error(listen(server_fd, MAX_STREAMS + 1), "Listen failed");
 
     std::cout << "[Network] Worker listening on port " << port << "..." << std::endl;
 
@@ -117,14 +207,40 @@ int start_server(int port) {
     check_error(new_socket, "Accept failed");
     
     // 为连接设置合理超时与较大缓冲区，避免长时间阻塞并提高吞吐
-    set_socket_timeout_and_buffers(new_socket, 30);
+    set_socket_timeout_and_buffers(new_socket, SOCKET_TIMEOUT_SEC);
     std::cout << "[Network] Master connected!" << std::endl;
-    
+
+    // 握手：Master 告知数据连接条数，随后逐条连入，每条连接先发送自己的条带序号
+    int32_t net_streams = 0;
+    recv_all(new_socket, &net_streams, sizeof(net_streams));
+    int streams = ntohl(net_streams);
+    if (streams <= 0 || streams > MAX_STREAMS) {
+        std::cerr << "[Network] invalid stream count from master: " << streams << std::endl;
+        exit(1);
+    }
+    std::vector<int> fds(streams, -1);
+    for (int i = 0; i < streams; ++i) {
+        int data_fd = accept(server_fd, nullptr, nullptr);
+        check_error(data_fd, "Accept (data stream) failed");
+        set_socket_timeout_and_buffers(data_fd, SOCKET_TIMEOUT_SEC);
+        int32_t net_idx = 0;
+        recv_all(data_fd, &net_idx, sizeof(net_idx));
+        int idx = ntohl(net_idx);
+        if (idx < 0 || idx >= streams || fds[idx] != -1) {
+            std::cerr << "[Network] invalid stream index from master: " << idx << std::endl;
+            exit(1);
+        }
+        fds[idx] = data_fd;
+    }
+    close(server_fd);
+    attach_stripes(new_socket, fds);
+    std::cout << "[Network] " << streams << " data stream(s) established." << std::endl;
+
     return new_socket;
 }
 
 // 2. Master: 连接服务器
-int connect_to_worker(std::string ip, int port) {
+int connect_to_worker(std::string ip, int port, int streams) {
     int sock = socket(AF_INET, SOCK_STREAM, 0);
     check_error(sock, "Socket creation failed");
 
@@ -153,8 +269,27 @@ int connect_to_worker(std::string ip, int port) {
     }
     
     // 连接建立后设置超时与缓冲区
-    set_socket_timeout_and_buffers(sock, 30);
+    set_socket_timeout_and_buffers(sock, SOCKET_TIMEOUT_SEC);
     std::cout << "[Network] Connected to Worker!" << std::endl;
+
+    // 打开并行数据连接：Worker 已在监听，无需重试
+    if (streams <= 0) streams = detect_nic_queues(sock);
+    streams = std::min(std::max(streams, 1), MAX_STREAMS);
+    int32_t net_streams = htonl(streams);
+    send_all(sock, &net_streams, sizeof(net_streams));
+
+    std::vector<int> fds(streams, -1);
+    for (int i = 0; i < streams; ++i) {
+        int data_fd = socket(AF_INET, SOCK_STREAM, 0);
+        check_error(data_fd, "Socket creation failed");
+        check_error(connect(data_fd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)), "Connect (data stream) failed");
+        set_socket_timeout_and_buffers(data_fd, SOCKET_TIMEOUT_SEC);
+        int32_t net_idx = htonl(i);
+        send_all(data_fd, &net_idx, sizeof(net_idx));
+        fds[i] = data_fd;
+    }
+    attach_stripes(sock, fds);
+    std::cout << "[Network] " << streams << " data stream(s) established." << std::endl;
     return sock;
 }
 
@@ -180,7 +315,201 @@ float recv_float(int fd) {
     return val;
 }
 
+void send_blob(int fd, const std::vector<char>& bytes) {
+    // 长度与内容合成一次发送：分两次写小包会被 Nagle 与对端延迟 ACK 卡住几十毫秒，干扰时钟握手
+    uint32_t net_len = htonl((uint32_t)bytes.size());
+    std::vector<char> buf(sizeof(net_len) + bytes.size());
+    std::memcpy(buf.data(), &net_len, sizeof(net_len));
+    std::copy(bytes.begin(), bytes.end(), buf.begin() + sizeof(net_len));
+    send_all(fd, buf.data(), buf.size());
+}
+
+std::vector<char> recv_blob(int fd) {
+    uint32_t net_len = 0;
+    recv_all(fd, &net_len, sizeof(net_len));
+    std::vector<char> bytes(ntohl(net_len));
+    if (!bytes.empty()) recv_all(fd, bytes.data(), bytes.size());
+    return bytes;
+}
+
+// 进度条（覆盖行）
+static void print_progress(const char* label, size_t done_bytes, size_t total_bytes) {
+    if (!g_transfer_log) return;
+    const int BAR_WIDTH = 50;
+    double progress = total_bytes > 0 ? (double)done_bytes / (double)total_bytes : 1.0;
+    int pos = (int)(BAR_WIDTH * progress);
+    std::cout << "[Network] " << label << ": [";
+    for (int i = 0; i < BAR_WIDTH; ++i) std::cout << (i < pos ? '=' : (i == pos ? '>' : ' '));
+    std::cout << "] " << int(progress * 100.0) << "% (" << (done_bytes / (1024*1024)) << " MB/" << (total_bytes / (1024*1024)) << " MB)\r" << std::flush;
+}
+
+// 一条数据连接负责的连续字节区间
+struct Stripe {
+    int fd;
+    char* base;
+    size_t len;
+    size_t done;
+};
+
+// 按 float 个数把 [0, len) 均分成连续区间，区间数取决于 len 与可用连接数，两端计算结果一致
+static std::vector<Stripe> plan_stripes(const StripeSet& set, char* buf, int len) {
+    size_t total_bytes = (size_t)len * sizeof(float);
+    size_t by_size = std::max<size_t>(total_bytes / MIN_STRIPE_BYTES, 1);
+    int n = (int)std::min<size_t>(set.fds.size(), by_size);
+    std::vector<Stripe> stripes(n);
+    size_t base = (size_t)len / n;
+    size_t extra = (size_t)len % n;
+    size_t offset = 0;
+    for (int i = 0; i < n; ++i) {
+        size_t count = base + ((size_t)i < extra ? 1 : 0);
+        stripes[i].fd = set.fds[i];
+        stripes[i].base = buf + offset * sizeof(float);
+        stripes[i].len = count * sizeof(float);
+        stripes[i].done = 0;
+        offset += count;
+    }
+    return stripes;
+}
+
+// 为第 idx 条带提交下一块收/发请求，user_data 记录条带序号
+// 直接在条带所在的用户缓冲上 SEND/RECV：socket 上固定缓冲省不掉内核与 skb 之间的拷贝，只会多一次中转
+static void queue_stripe_io(IoRing& ring, std::vector<Stripe>& stripes, int idx, bool is_send) {
+    Stripe& st = stripes[idx];
+    struct io_uring_sqe* sqe = ring.get_sqe();
+    if (!sqe) {
+        std::cerr << "[Network] io_uring submission queue full" << std::endl;
+        exit(1);
+    }
+    size_t n = std::min(IO_CHUNK, st.len - st.done);
+    sqe->opcode = is_send ? IORING_OP_SEND : IORING_OP_RECV;
+#ifdef MSG_NOSIGNAL
+    if (is_send) sqe->msg_flags = MSG_NOSIGNAL;
+#endif
+    sqe->fd = st.fd;
+    sqe->addr = (unsigned long long)(uintptr_t)(st.base + st.done);
+    sqe->len = (unsigned)n;
+    sqe->off = 0;
+    sqe->user_data = (unsigned long long)idx;
+}
+
+// io_uring 路径：每条连接始终保持一个在途请求，完成一个就续提交下一块
+static void transfer_uring(IoRing& ring, std::vector<Stripe>& stripes, bool is_send, size_t total_bytes) {
+    const char* label = is_send ? "Sending" : "Receiving";
+    int n = (int)stripes.size();
+
+    int inflight = 0;
+    for (int i = 0; i < n; ++i) {
+        if (stripes[i].len == 0) continue;
+        queue_stripe_io(ring, stripes, i, is_send);
+        ++inflight;
+    }
+
+    size_t done_bytes = 0;
+    while (inflight > 0) {
+        int ret = ring.submit_and_wait(1, SOCKET_TIMEOUT_SEC * 1000);
+        if (ret == -EINTR) continue;
+        if (ret < 0) {
+            errno = -ret;
+            check_error(-1, is_send ? "send_data: io_uring wait failed" : "recv_data: io_uring wait failed");
+        }
+
+        struct io_uring_cqe* cqe;
+        while (ring.peek_cqe(&cqe)) {
+            int idx = (int)cqe->user_data;
+            int res = cqe->res;
+            ring.cqe_seen();
+            Stripe& st = stripes[idx];
+
+            if (res == -EINTR || res == -EAGAIN) {
+                queue_stripe_io(ring, stripes, idx, is_send);
+                continue;
+            }
+            if (res < 0) {
+                errno = -res;
+                check_error(-1, is_send ? "send_data: send failed" : "recv_data: recv failed");
+            }
+            if (res == 0 && !is_send) {
+                check_error(-1, "recv_data: peer closed");
+            }
+
+            st.done += (size_t)res;
+            done_bytes += (size_t)res;
+            print_progress(label, done_bytes, total_bytes);
+            if (st.done < st.len) {
+                queue_stripe_io(ring, stripes, idx, is_send);
+            } else {
+                --inflight;
+            }
+        }
+    }
+}
+
+// poll() 回退路径：非阻塞地轮流推进各条连接
+static void transfer_poll(std::vector<Stripe>& stripes, bool is_send, size_t total_bytes) {
+    const char* label = is_send ? "Sending" : "Receiving";
+    size_t done_bytes = 0;
+    std::vector<struct pollfd> pfds;
+    std::vector<int> owner;
+    while (true) {
+        pfds.clear();
+        owner.clear();
+        for (int i = 0; i < (int)stripes.size(); ++i) {
+            if (stripes[i].done >= stripes[i].len) continue;
+            struct pollfd p;
+            p.fd = stripes[i].fd;
+            p.events = is_send ? POLLOUT : POLLIN;
+            p.revents = 0;
+            pfds.push_back(p);
+            owner.push_back(i);
+        }
+        if (pfds.empty()) break;
+
+        int ret = poll(pfds.data(), pfds.size(), SOCKET_TIMEOUT_SEC * 1000);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret == 0) errno = ETIMEDOUT;
+        if (ret <= 0) check_error(-1, is_send ? "send_data: poll failed" : "recv_data: poll failed");
+
+        for (size_t k = 0; k < pfds.size(); ++k) {
+            if (!pfds[k].revents) continue;
+            Stripe& st = stripes[owner[k]];
+            size_t n = std::min(IO_CHUNK, st.len - st.done);
+            ssize_t r;
+            if (is_send) {
+#ifdef MSG_NOSIGNAL
+                r = send(st.fd, st.base + st.done, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+                r = send(st.fd, st.base + st.done, n, MSG_DONTWAIT);
+#endif
+            } else {
+                r = recv(st.fd, st.base + st.done, n, MSG_DONTWAIT);
+            }
+            if (r < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                check_error(-1, is_send ? "send_data: send failed" : "recv_data: recv failed");
+            }
+            if (r == 0 && !is_send) {
+                check_error(-1, "recv_data: peer closed");
+            }
+            st.done += (size_t)r;
+            done_bytes += (size_t)r;
+            print_progress(label, done_bytes, total_bytes);
+        }
+    }
+}
+
+static void transfer_stripes(StripeSet& set, char* buf, int len, bool is_send) {
+    std::vector<Stripe> stripes = plan_stripes(set, buf, len);
+    size_t total_bytes = (size_t)len * sizeof(float);
+    if (set.ring.ok()) {
+        transfer_uring(set.ring, stripes, is_send, total_bytes);
+    } else {
+        transfer_poll(stripes, is_send, total_bytes);
+    }
+    if (g_transfer_log) std::cout << std::endl;
+}
+
 void send_data(int fd, const float* data, int len) {
+    TraceSpan span("send_data", (int64_t)len * sizeof(float));
     using namespace std::chrono;
     auto t0 = high_resolution_clock::now();
 
@@ -188,41 +517,23 @@ void send_data(int fd, const float* data, int len) {
     int32_t net_len = htonl(len);
     send_all(fd, &net_len, sizeof(net_len));
 
-    // 分块发送数据并显示进度条
+    // 数据按区间切分到各数据连接上并发发送
+    StripeSet& set = stripes_of(fd);
     size_t total_bytes = (size_t)len * sizeof(float);
-    const size_t CHUNK = 1024 * 1024; // 1MB
-    size_t sent_bytes = 0;
-    const int BAR_WIDTH = 50;
-    while (sent_bytes < total_bytes) {
-        size_t to_send = std::min(CHUNK, total_bytes - sent_bytes);
-#ifdef MSG_NOSIGNAL
-        ssize_t s = send(fd, reinterpret_cast<const char*>(data) + sent_bytes, to_send, MSG_NOSIGNAL);
-#else
-        ssize_t s = send(fd, reinterpret_cast<const char*>(data) + sent_bytes, to_send, 0);
-#endif
-        if (s < 0) {
-            if (errno == EINTR) continue;
-            check_error(-1, "send_data: send failed");
-        }
-        sent_bytes += (size_t)s;
-
-        // 打印进度条（覆盖行）
-        double progress = (double)sent_bytes / (double)total_bytes;
-        int pos = (int)(BAR_WIDTH * progress);
-        std::cout << "[Network] Sending: [";
-        for (int i = 0; i < BAR_WIDTH; ++i) std::cout << (i < pos ? '=' : (i == pos ? '>' : ' '));
-        std::cout << "] " << int(progress * 100.0) << "% (" << (sent_bytes / (1024*1024)) << " MB/" << (total_bytes / (1024*1024)) << " MB)\r" << std::flush;
+    if (len > 0) {
+        transfer_stripes(set, reinterpret_cast<char*>(const_cast<float*>(data)), len, true);
     }
-    std::cout << std::endl;
 
     auto t1 = high_resolution_clock::now();
     double ms = duration<double, std::milli>(t1 - t0).count();
     double mb = total_bytes / (1024.0 * 1024.0);
     double bw = ms > 0 ? mb / (ms / 1000.0) : 0.0;
+    if (!g_transfer_log) return;
     std::cout << "[Network] send_data: sent " << len << " floats (" << mb << " MB) in " << ms << " ms, " << bw << " MB/s" << std::endl;
 }
 
 void recv_data(int fd, float* data, int len) {
+    TraceSpan span("recv_data", (int64_t)len * sizeof(float));
     using namespace std::chrono;
     auto t0 = high_resolution_clock::now();
 
@@ -239,45 +550,31 @@ void recv_data(int fd, float* data, int len) {
         std::cerr << "[Network] recv_data: expected len=" << len << " but remote sent=" << remote_len << ", will adjust read." << std::endl;
     }
 
+    // 条带划分由远端长度决定；若远端发送更多数据，先整体收进临时缓冲再截取，以保持各连接流同步
+    StripeSet& set = stripes_of(fd);
     int to_read = std::min(remote_len, len);
     size_t total_bytes = (size_t)to_read * sizeof(float);
-    const size_t CHUNK = 1024 * 1024; // 1MB
-    size_t recvd_bytes = 0;
-    const int BAR_WIDTH = 50;
-    while (recvd_bytes < total_bytes) {
-        size_t to_recv = std::min(CHUNK, total_bytes - recvd_bytes);
-        ssize_t r = recv(fd, reinterpret_cast<char*>(data) + recvd_bytes, to_recv, 0);
-        if (r < 0) {
-            if (errno == EINTR) continue;
-            check_error(-1, "recv_data: recv failed");
-        }
-        if (r == 0) {
-            check_error(-1, "recv_data: peer closed");
-        }
-        recvd_bytes += (size_t)r;
-
-        double progress = (double)recvd_bytes / (double)total_bytes;
-        int pos = (int)(BAR_WIDTH * progress);
-        std::cout << "[Network] Receiving: [";
-        for (int i = 0; i < BAR_WIDTH; ++i) std::cout << (i < pos ? '=' : (i == pos ? '>' : ' '));
-        std::cout << "] " << int(progress * 100.0) << "% (" << (recvd_bytes / (1024*1024)) << " MB/" << (total_bytes / (1024*1024)) << " MB)\r" << std::flush;
-    }
-    std::cout << std::endl;
-
-    // 如果远端发送更多数据，消耗剩余字节以保持流同步
     if (remote_len > len) {
-        size_t remaining = (size_t)(remote_len - len) * sizeof(float);
-        std::vector<char> tmp(remaining);
-        recv_all(fd, tmp.data(), remaining);
+        std::vector<float> tmp(remote_len);
+        transfer_stripes(set, reinterpret_cast<char*>(tmp.data()), remote_len, false);
+        std::copy(tmp.begin(), tmp.begin() + len, data);
+    } else {
+        transfer_stripes(set, reinterpret_cast<char*>(data), remote_len, false);
     }
 
     auto t1 = high_resolution_clock::now();
     double ms = duration<double, std::milli>(t1 - t0).count();
     double mb = total_bytes / (1024.0 * 1024.0);
     double bw = ms > 0 ? mb / (ms / 1000.0) : 0.0;
+    if (!g_transfer_log) return;
     std::cout << "[Network] recv_data: recv " << to_read << " floats (" << mb << " MB) in " << ms << " ms, " << bw << " MB/s" << std::endl;
 }
 
 void close_socket(int fd) {
+    auto it = g_stripe_sets.find(fd);
+    if (it != g_stripe_sets.end()) {
+        for (int data_fd : it->second->fds) close(data_fd);
+        g_stripe_sets.erase(it);
+    }
     close(fd);
 }
\ No newline at end of file
@@ -2,14 +2,21 @@
 #define NETWORK_H
 
 #include <string>
+#include <vector>
+
+// 条带传输：大数组被切成若干连续段，分别走并行的数据连接，接收端按段直接写回原位
+// 单条 TCP 流受限于单个网卡队列/单核软中断，多流可以分散到绑定网卡或多队列网卡上
+#define MAX_STREAMS 16
 
 // === 基础通信函数 ===
 
-// 启动 Server (Worker)，返回与 Master 建立连接后的 socket 文件描述符
+// 启动 Server (Worker)，返回与 Master 建立连接后的控制 socket 文件描述符
+// 数据连接的条数由 Master 在握手时告知，Worker 随后在同一端口上接受这些连接
 int start_server(int port);
 
-// 启动 Client (Master)，连接指定 IP 和端口，返回 socket 文件描述符
-int connect_to_worker(std::string ip, int port);
+// 启动 Client (Master)，连接指定 IP 和端口，返回控制 socket 文件描述符
+// streams 为并行数据连接数；<= 0 时按本地出口网卡的接收队列数自动选择（上限 MAX_STREAMS）
+int connect_to_worker(std::string ip, int port, int streams = 0);
 
 // 发送一个指令 (如 CMD_SUM)
 void send_cmd(int fd, int cmd);
@@ -22,13 +29,23 @@ void send_float(int fd, float val);
 float recv_float(int fd);
 
 // 发送/接收 大数组 (用于 Sort 结果)
-// 协议：先发送 int32_t(length)（网络字节序），随后紧跟 length 个 float 原始字节
+// 协议：先在控制连接上发送 int32_t(length)（网络字节序），随后 length 个 float 原始字节
+// 按连续区间切分到各数据连接上并发传输（区间划分只由 length 与连接数决定，两端一致）
 // recv_data 会先读取长度并按长度接收数据；若接收缓冲小于远端发送长度，会丢弃多余字节以保持流同步
-// 该模块会为 socket 设置超时并在发送/接收过程中分块与重试以提高鲁棒性
+// 收发由 io_uring 提交/完成循环驱动（直接在数据所在缓冲上 SEND/RECV），内核不支持时回退到 poll()
 void send_data(int fd, const float* data, int len);
 void recv_data(int fd, float* data, int len);
 
-// 关闭连接
+// 开关 send_data/recv_data 的进度条与带宽输出（默认开启）
+// 查询服务模式下每次传输都落在延迟窗口内，终端输出会计入尾延迟，需在启动时关闭
+void set_transfer_log(bool enabled);
+
+// 发送/接收 变长字节块 (用于追踪数据)，走控制连接
+// 协议：先发送 uint32_t(字节数)（网络字节序），随后紧跟原始字节
+void send_blob(int fd, const std::vector<char>& bytes);
+std::vector<char> recv_blob(int fd);
+
+// 关闭连接（同时关闭该控制连接下的所有数据连接）
 void close_socket(int fd);
 
 #endif
\ No newline at end of file
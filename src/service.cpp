@@ -0,0 +1,390 @@
+#include "service.h"
+#include "algorithm.h"
+#include "network.h"
+#include "histogram.h"
+#include "trace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <algorithm>
+#include <omp.h>
+
+extern int g_streams;
+extern std::string g_trace_path;
+extern int g_local_len;
+void final_merge(const float* partA, int lenA, const float* partB, int lenB, float* result);
+
+using Clock = std::chrono::steady_clock;
+
+// 负载描述
+struct WorkloadSpec {
+    std::vector<int> cmds;          // 查询组合中的命令
+    std::vector<double> weights;    // 对应权重
+    double rate = 100.0;            // 目标到达速率（查询/秒）
+    int concurrency = 4;            // 同时在途查询上限
+    int sort_concurrency = 1;       // 同时在途排序查询上限（每条约占 8 份 half_len 个 float 的内存）
+    double duration = 10.0;         // 压测时长（秒）
+    bool poisson = true;            // 到达过程：泊松 / 等间隔
+    unsigned seed = 42;
+};
+
+static const int NUM_CMDS = CMD_SORT_SPEEDUP + 1;
+
+static const char* cmd_name(int cmd) {
+    switch (cmd) {
+        case CMD_SUM: return "sum";
+        case CMD_MAX: return "max";
+        case CMD_SORT: return "sort";
+        case CMD_SUM_SPEEDUP: return "sum_speedup";
+        case CMD_MAX_SPEEDUP: return "max_speedup";
+        case CMD_SORT_SPEEDUP: return "sort_speedup";
+    }
+    return "unknown";
+}
+
+static bool is_sort_cmd(int cmd) {
+    return cmd == CMD_SORT || cmd == CMD_SORT_SPEEDUP;
+}
+
+static std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static void spec_error(const std::string& path, int line_no, const std::string& msg) {
+    std::cerr << "[Service] " << path << ":" << line_no << ": " << msg << std::endl;
+    exit(1);
+}
+
+static WorkloadSpec load_spec(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "[Service] cannot open workload spec: " << path << std::endl;
+        exit(1);
+    }
+
+    WorkloadSpec spec;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line = line.substr(0, hash);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) spec_error(path, line_no, "expected key=value");
+        std::string key = trim(line.substr(0, eq));
+        std::string val = trim(line.substr(eq + 1));
+
+        if (key == "mix") {
+            std::stringstream ss(val);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                item = trim(item);
+                size_t colon = item.find(':');
+                std::string name = trim(item.substr(0, colon));
+                double w = colon == std::string::npos ? 1.0 : std::atof(item.c_str() + colon + 1);
+                int cmd = -1;
+                for (int c = CMD_SUM; c < NUM_CMDS; ++c) {
+                    if (name == cmd_name(c)) cmd = c;
+                }
+                if (cmd < 0) spec_error(path, line_no, "unknown command in mix: " + name);
+                if (w <= 0) spec_error(path, line_no, "mix weight must be positive: " + item);
+                spec.cmds.push_back(cmd);
+                spec.weights.push_back(w);
+            }
+        } else if (key == "rate") {
+            spec.rate = std::atof(val.c_str());
+        } else if (key == "concurrency") {
+            spec.concurrency = std::atoi(val.c_str());
+        } else if (key == "sort_concurrency") {
+            spec.sort_concurrency = std::atoi(val.c_str());
+        } else if (key == "duration") {
+            spec.duration = std::atof(val.c_str());
+        } else if (key == "arrival") {
+            if (val == "poisson") spec.poisson = true;
+            else if (val == "uniform") spec.poisson = false;
+            else spec_error(path, line_no, "arrival must be poisson or uniform");
+        } else if (key == "seed") {
+            spec.seed = (unsigned)std::strtoul(val.c_str(), nullptr, 10);
+        } else {
+            spec_error(path, line_no, "unknown key: " + key);
+        }
+    }
+
+    if (spec.cmds.empty()) spec_error(path, line_no, "mix is empty");
+    if (spec.rate <= 0 || spec.concurrency <= 0 || spec.sort_concurrency <= 0 || spec.duration <= 0) {
+        spec_error(path, line_no, "rate, concurrency, sort_concurrency and duration must be positive");
+    }
+    return spec;
+}
+
+// 一次到达：命令类型 + 计划到达时刻
+struct Arrival {
+    int cmd;
+    Clock::time_point intended;
+};
+
+// 一组排序查询用的缓冲，首次使用时分配，之后在查询间复用
+struct SortBuffers {
+    std::vector<float> local_sorted;
+    std::vector<float> remote_data;
+    std::vector<float> final_res;
+};
+
+// 一条在途查询；Worker 的回包由接收线程填入后通过 promise 通知执行线程
+struct Query {
+    int cmd;
+    float remote_val = 0.0f;
+    SortBuffers* bufs = nullptr;    // 仅排序查询持有
+    std::promise<void> remote_done;
+};
+
+// 各线程共享的状态
+struct ServiceState {
+    int sock;
+    int half_len;
+    const float* local_data;
+    int omp_threads;                // 每个执行线程的 OpenMP 线程数
+
+    // 排序缓冲池：池的大小即同时在途排序查询的上限，取不到时排队等待（计入该查询延迟）
+    std::mutex sort_mtx;
+    std::condition_variable sort_cv;
+    std::vector<SortBuffers> sort_bufs;
+    std::vector<SortBuffers*> sort_free;
+
+    // 到达队列（调度线程 -> 执行线程）
+    std::mutex arrivals_mtx;
+    std::condition_variable arrivals_cv;
+    std::deque<Arrival> arrivals;
+    bool arrivals_closed = false;
+    size_t max_backlog = 0;
+
+    // 按发送顺序排列的在途查询（执行线程 -> 接收线程），Worker 按同样顺序回包
+    std::mutex inflight_mtx;
+    std::condition_variable inflight_cv;
+    std::deque<Query*> inflight;
+    bool receiver_stop = false;
+};
+
+// 接收线程：按 FIFO 顺序读取 Worker 回包并交给对应查询
+static void receiver_loop(ServiceState* st) {
+    while (true) {
+        Query* q;
+        {
+            std::unique_lock<std::mutex> lock(st->inflight_mtx);
+            st->inflight_cv.wait(lock, [st] { return !st->inflight.empty() || st->receiver_stop; });
+            if (st->inflight.empty()) return;
+            q = st->inflight.front();
+            st->inflight.pop_front();
+        }
+        if (is_sort_cmd(q->cmd)) {
+            q->bufs->remote_data.resize(st->half_len);
+            recv_data(st->sock, q->bufs->remote_data.data(), st->half_len);
+        } else {
+            q->remote_val = recv_float(st->sock);
+        }
+        q->remote_done.set_value();
+    }
+}
+
+// 执行线程：取到达 -> 发命令 -> 本地计算 -> 等远端结果 -> 合并并记录延迟
+static void executor_loop(ServiceState* st, std::vector<LatencyHistogram>* hists) {
+    // 各执行线程平分核心，避免多个 OpenMP 线程组互相抢占，让尾延迟反映服务本身而不是压测端的超额订阅
+    omp_set_num_threads(st->omp_threads);
+    while (true) {
+        Arrival a;
+        {
+            std::unique_lock<std::mutex> lock(st->arrivals_mtx);
+            st->arrivals_cv.wait(lock, [st] { return !st->arrivals.empty() || st->arrivals_closed; });
+            if (st->arrivals.empty()) return;
+            a = st->arrivals.front();
+            st->arrivals.pop_front();
+        }
+
+        Query q;
+        q.cmd = a.cmd;
+        if (is_sort_cmd(q.cmd)) {
+            // 先占到排序缓冲再发命令，接收线程直接收进该缓冲
+            std::unique_lock<std::mutex> lock(st->sort_mtx);
+            st->sort_cv.wait(lock, [st] { return !st->sort_free.empty(); });
+            q.bufs = st->sort_free.back();
+            st->sort_free.pop_back();
+        }
+        std::future<void> remote = q.remote_done.get_future();
+        {
+            // 发送与入队必须原子完成，保证在途队列顺序与 Worker 的处理顺序一致
+            std::lock_guard<std::mutex> lock(st->inflight_mtx);
+            send_cmd(st->sock, q.cmd);
+            st->inflight.push_back(&q);
+        }
+        st->inflight_cv.notify_one();
+
+        const float* data = st->local_data;
+        int len = st->half_len;
+        float local_val = 0.0f;
+        switch (q.cmd) {
+            case CMD_SUM: local_val = sum(data, len); break;
+            case CMD_MAX: local_val = max(data, len); break;
+            case CMD_SUM_SPEEDUP: local_val = sumSpeedUp(data, len); break;
+            case CMD_MAX_SPEEDUP: local_val = maxSpeedUp(data, len); break;
+            case CMD_SORT:
+            case CMD_SORT_SPEEDUP:
+                q.bufs->local_sorted.resize(len);
+                q.bufs->final_res.resize(2 * (size_t)len);
+                if (q.cmd == CMD_SORT) sort(data, len, q.bufs->local_sorted.data());
+                else sortSpeedUp(data, len, q.bufs->local_sorted.data());
+                break;
+        }
+
+        // 与 run_master 相同的合并方式：SUM 相加、MAX 取大、SORT 主机归并
+        remote.wait();
+        float result = 0.0f;
+        if (is_sort_cmd(q.cmd)) {
+            final_merge(q.bufs->local_sorted.data(), len, q.bufs->remote_data.data(), len, q.bufs->final_res.data());
+            {
+                std::lock_guard<std::mutex> lock(st->sort_mtx);
+                st->sort_free.push_back(q.bufs);
+            }
+            st->sort_cv.notify_one();
+        } else if (q.cmd == CMD_SUM || q.cmd == CMD_SUM_SPEEDUP) {
+            result = local_val + q.remote_val;
+        } else {
+            result = local_val > q.remote_val ? local_val : q.remote_val;
+        }
+        (void)result;
+
+        // 查询区间从计划到达时刻算起；libstdc++ 的 steady_clock 即 CLOCK_MONOTONIC，与追踪时钟一致
+        trace_record(cmd_name(q.cmd), std::chrono::duration_cast<std::chrono::nanoseconds>(a.intended.time_since_epoch()).count(),
+                     trace_now_ns());
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - a.intended).count();
+        (*hists)[q.cmd].record(us > 0 ? (uint64_t)us : 0);
+    }
+}
+
+static void print_row(const char* name, const LatencyHistogram& h, double elapsed_sec) {
+    double qps = elapsed_sec > 0 ? h.count() / elapsed_sec : 0.0;
+    std::cout << std::left << std::setw(13) << name << std::right
+              << "| " << std::setw(8) << h.count()
+              << " | " << std::setw(9) << qps
+              << " | " << std::setw(9) << h.mean() / 1000.0
+              << " | " << std::setw(9) << h.percentile(50.0) / 1000.0
+              << " | " << std::setw(9) << h.percentile(99.0) / 1000.0
+              << " | " << std::setw(9) << h.percentile(99.9) / 1000.0
+              << " | " << std::setw(9) << h.max() / 1000.0 << std::endl;
+}
+
+void run_service(std::string ip, int port, const std::string& spec_path) {
+    std::cout << "=== Running as MASTER (query service) ===" << std::endl;
+    WorkloadSpec spec = load_spec(spec_path);
+
+    int half_len = g_local_len;
+    std::vector<float> local_data(half_len);
+    init_data(local_data.data(), half_len, 0);
+
+    int sock = connect_to_worker(ip, port, g_streams);
+    // 每次查询的传输与 Worker 的命令处理都在延迟窗口内，两端都关掉逐次输出
+    set_transfer_log(false);
+    send_cmd(sock, CMD_QUIET);
+    if (!g_trace_path.empty()) trace_start_session(sock);
+
+    ServiceState st;
+    st.sock = sock;
+    st.half_len = half_len;
+    st.local_data = local_data.data();
+    st.omp_threads = std::max(1, omp_get_num_procs() / spec.concurrency);
+    int sort_slots = std::min(spec.sort_concurrency, spec.concurrency);
+    st.sort_bufs.resize(sort_slots);
+    for (SortBuffers& b : st.sort_bufs) st.sort_free.push_back(&b);
+
+    std::cout << "[Service] rate=" << spec.rate << " qps, concurrency=" << spec.concurrency
+              << ", sort_concurrency=" << sort_slots << ", omp_threads/executor=" << st.omp_threads
+              << ", duration=" << spec.duration << " s, arrival=" << (spec.poisson ? "poisson" : "uniform") << std::endl;
+
+    // 每个执行线程各用一组直方图，结束后合并，记录路径上无需加锁
+    std::vector<std::vector<LatencyHistogram>> per_thread(spec.concurrency, std::vector<LatencyHistogram>(NUM_CMDS));
+    std::thread receiver(receiver_loop, &st);
+    std::vector<std::thread> executors;
+    for (int i = 0; i < spec.concurrency; ++i) {
+        executors.emplace_back(executor_loop, &st, &per_thread[i]);
+    }
+
+    // 开环调度：按到达过程生成计划时刻，到点即入队，不等待前面的查询完成
+    std::mt19937_64 rng(spec.seed);
+    std::discrete_distribution<int> pick(spec.weights.begin(), spec.weights.end());
+    std::exponential_distribution<double> gap(spec.rate);
+    auto start = Clock::now();
+    auto stop = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spec.duration));
+    double offset = 0.0;
+    uint64_t issued = 0;
+    while (true) {
+        offset += spec.poisson ? gap(rng) : 1.0 / spec.rate;
+        auto intended = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset));
+        if (intended >= stop) break;
+        std::this_thread::sleep_until(intended);
+        {
+            std::lock_guard<std::mutex> lock(st.arrivals_mtx);
+            st.arrivals.push_back(Arrival{spec.cmds[pick(rng)], intended});
+            st.max_backlog = std::max(st.max_backlog, st.arrivals.size());
+        }
+        st.arrivals_cv.notify_one();
+        ++issued;
+    }
+
+    // 停止到达，等待积压的查询全部完成
+    {
+        std::lock_guard<std::mutex> lock(st.arrivals_mtx);
+        st.arrivals_closed = true;
+    }
+    st.arrivals_cv.notify_all();
+    for (auto& t : executors) t.join();
+    auto end = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(st.inflight_mtx);
+        st.receiver_stop = true;
+    }
+    st.inflight_cv.notify_all();
+    receiver.join();
+
+    std::vector<LatencyHistogram> hists(NUM_CMDS);
+    LatencyHistogram all;
+    for (auto& thread_hists : per_thread) {
+        for (int c = 0; c < NUM_CMDS; ++c) {
+            hists[c].merge(thread_hists[c]);
+            all.merge(thread_hists[c]);
+        }
+    }
+    double elapsed = std::chrono::duration<double>(end - start).count();
+
+    // ============================================
+    // 最终结果
+    // ============================================
+    std::cout << "\n===========================================" << std::endl;
+    std::cout << "             Service Report                " << std::endl;
+    std::cout << "===========================================" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Target: " << spec.rate << " qps | Issued: " << issued << " | Elapsed: " << elapsed
+              << " s | Sustained: " << (elapsed > 0 ? all.count() / elapsed : 0.0) << " qps | Max backlog: " << st.max_backlog << std::endl;
+    std::cout << "Command      |    Count |       QPS | Mean (ms) |  p50 (ms) |  p99 (ms) | p999 (ms) |  Max (ms)" << std::endl;
+    std::cout << "-------------|----------|-----------|-----------|-----------|-----------|-----------|----------" << std::endl;
+    for (int c = CMD_SUM; c < NUM_CMDS; ++c) {
+        if (hists[c].count() > 0) print_row(cmd_name(c), hists[c], elapsed);
+    }
+    print_row("ALL", all, elapsed);
+
+    if (!g_trace_path.empty()) trace_finish_session(sock, g_trace_path);
+    close_socket(sock);
+}
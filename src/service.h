@@ -0,0 +1,21 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <string>
+
+// === 查询服务模式 (Master) ===
+// 按负载描述文件开环地驱动 Worker：查询按设定速率到达（与完成与否无关），
+// 最多 concurrency 个查询同时在途，Worker 侧在同一连接上按 FIFO 流水处理。
+// 每条查询的延迟从"计划到达时刻"算起（避免协调遗漏），按命令类型记入 HDR 直方图，
+// 结束时报告持续 QPS 以及 p50/p99/p999。
+//
+// 负载描述文件为 key=value 文本，# 开头为注释：
+//   mix=sum_speedup:6,max_speedup:3,sort_speedup:1   查询组合及权重（命令名见 README）
+//   rate=200                                          目标到达速率（查询/秒）
+//   concurrency=4                                     同时在途查询上限
+//   duration=30                                       压测时长（秒）
+//   arrival=poisson                                   到达过程：poisson 或 uniform
+//   seed=42                                           随机种子
+void run_service(std::string ip, int port, const std::string& spec_path);
+
+#endif
@@ -0,0 +1,288 @@
+#include "sort_kernels.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SORT_KERNEL_SIMD 1
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define SORT_KERNEL_SIMD 1
+#endif
+
+// === 无分支标量归并 ===
+// 比较结果直接参与下标运算，编译器生成 cmov 而不是条件跳转，避免随机数据上的分支预测失败
+static void merge_scalar(const int64_t* a, size_t na, const int64_t* b, size_t nb, int64_t* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        int64_t x = a[i];
+        int64_t y = b[j];
+        bool take_b = y < x;       // 相等时取 a，保持稳定
+        out[k++] = take_b ? y : x;
+        i += !take_b;
+        j += take_b;
+    }
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+}
+
+#ifdef SORT_KERNEL_SIMD
+
+#if defined(__AVX2__)
+// AVX2：每个寄存器 4 个 64 位键
+typedef __m256i vec_t;
+static const int VEC_LANES = 4;
+
+static inline vec_t vload(const int64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+static inline void vstore(int64_t* p, vec_t v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+// 逐通道比较交换：a 取较小值，b 取较大值
+static inline void cmpswap(vec_t& a, vec_t& b) {
+    vec_t gt = _mm256_cmpgt_epi64(a, b);
+    vec_t lo = _mm256_blendv_epi8(a, b, gt);
+    b = _mm256_blendv_epi8(b, a, gt);
+    a = lo;
+}
+
+static inline vec_t vreverse(vec_t v) { return _mm256_permute4x64_epi64(v, 0x1B); }
+
+// 寄存器内的双调清理：输入为双调序列，输出升序
+static inline vec_t vclean(vec_t v) {
+    vec_t s = _mm256_permute4x64_epi64(v, 0x4E);   // 距离 2
+    vec_t gt = _mm256_cmpgt_epi64(v, s);
+    vec_t mn = _mm256_blendv_epi8(v, s, gt);
+    vec_t mx = _mm256_blendv_epi8(s, v, gt);
+    v = _mm256_blend_epi32(mn, mx, 0xF0);
+    s = _mm256_permute4x64_epi64(v, 0xB1);          // 距离 1
+    gt = _mm256_cmpgt_epi64(v, s);
+    mn = _mm256_blendv_epi8(v, s, gt);
+    mx = _mm256_blendv_epi8(s, v, gt);
+    return _mm256_blend_epi32(mn, mx, 0xCC);
+}
+
+#else
+// SSE4.2：每个寄存器 2 个 64 位键（_mm_cmpgt_epi64 正是 SSE4.2 引入的指令）
+typedef __m128i vec_t;
+static const int VEC_LANES = 2;
+
+static inline vec_t vload(const int64_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+static inline void vstore(int64_t* p, vec_t v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+
+static inline void cmpswap(vec_t& a, vec_t& b) {
+    vec_t gt = _mm_cmpgt_epi64(a, b);
+    vec_t lo = _mm_blendv_epi8(a, b, gt);
+    b = _mm_blendv_epi8(b, a, gt);
+    a = lo;
+}
+
+static inline vec_t vreverse(vec_t v) { return _mm_shuffle_epi32(v, 0x4E); }
+
+static inline vec_t vclean(vec_t v) {
+    vec_t s = _mm_shuffle_epi32(v, 0x4E);
+    vec_t gt = _mm_cmpgt_epi64(v, s);
+    vec_t mn = _mm_blendv_epi8(v, s, gt);
+    vec_t mx = _mm_blendv_epi8(s, v, gt);
+    return _mm_blend_epi16(mn, mx, 0xF0);
+}
+#endif
+
+// 双调归并：a、b 各为一个寄存器的有序段，归并后 a 为较小一半、b 为较大一半
+static inline void merge_1x1(vec_t& a, vec_t& b) {
+    b = vreverse(b);
+    cmpswap(a, b);
+    a = vclean(a);
+    b = vclean(b);
+}
+
+// 双调归并：(a0,a1) 与 (b0,b1) 各为两个寄存器宽的有序段，归并结果依次放在 a0,a1,b0,b1
+static inline void merge_2x2(vec_t& a0, vec_t& a1, vec_t& b0, vec_t& b1) {
+    vec_t r0 = vreverse(b1);
+    vec_t r1 = vreverse(b0);
+    cmpswap(a0, r0);
+    cmpswap(a1, r1);
+    cmpswap(a0, a1);
+    cmpswap(r0, r1);
+    a0 = vclean(a0);
+    a1 = vclean(a1);
+    b0 = vclean(r0);
+    b1 = vclean(r1);
+}
+
+// 寄存器内排序网络一次处理的块大小
+static const int BLOCK = 4 * VEC_LANES;
+
+// 对 4 个寄存器（BLOCK 个键）排序：列排序网络 -> 转置成有序段 -> 双调归并
+static inline void sort_block(int64_t* p) {
+    vec_t r0 = vload(p);
+    vec_t r1 = vload(p + VEC_LANES);
+    vec_t r2 = vload(p + 2 * VEC_LANES);
+    vec_t r3 = vload(p + 3 * VEC_LANES);
+
+    // 4 输入最优排序网络，各通道独立完成列排序
+    cmpswap(r0, r1);
+    cmpswap(r2, r3);
+    cmpswap(r0, r2);
+    cmpswap(r1, r3);
+    cmpswap(r1, r2);
+
+#if defined(__AVX2__)
+    // 4x4 转置：每个寄存器变成一段长度 4 的有序序列
+    vec_t t0 = _mm256_unpacklo_epi64(r0, r1);
+    vec_t t1 = _mm256_unpackhi_epi64(r0, r1);
+    vec_t t2 = _mm256_unpacklo_epi64(r2, r3);
+    vec_t t3 = _mm256_unpackhi_epi64(r2, r3);
+    vec_t c0 = _mm256_permute2x128_si256(t0, t2, 0x20);
+    vec_t c1 = _mm256_permute2x128_si256(t1, t3, 0x20);
+    vec_t c2 = _mm256_permute2x128_si256(t0, t2, 0x31);
+    vec_t c3 = _mm256_permute2x128_si256(t1, t3, 0x31);
+    merge_1x1(c0, c1);
+    merge_1x1(c2, c3);
+    merge_2x2(c0, c1, c2, c3);
+#else
+    // 2 列长度 4 的有序段，各占两个寄存器
+    vec_t c0 = _mm_unpacklo_epi64(r0, r1);
+    vec_t c1 = _mm_unpacklo_epi64(r2, r3);
+    vec_t c2 = _mm_unpackhi_epi64(r0, r1);
+    vec_t c3 = _mm_unpackhi_epi64(r2, r3);
+    merge_2x2(c0, c1, c2, c3);
+#endif
+
+    vstore(p, c0);
+    vstore(p + VEC_LANES, c1);
+    vstore(p + 2 * VEC_LANES, c2);
+    vstore(p + 3 * VEC_LANES, c3);
+}
+
+#else
+// 无 SIMD 时退化为插入排序的小块
+static const int BLOCK = 8;
+
+static inline void sort_block(int64_t* p) {
+    for (int i = 1; i < BLOCK; ++i) {
+        int64_t x = p[i];
+        int j = i - 1;
+        while (j >= 0 && p[j] > x) {
+            p[j + 1] = p[j];
+            --j;
+        }
+        p[j + 1] = x;
+    }
+}
+#endif
+
+void merge_keys(const int64_t* a, int na, const int64_t* b, int nb, int64_t* out) {
+#ifdef SORT_KERNEL_SIMD
+    // 每步从两侧中队首较小的一侧取 2 个寄存器宽度，与上一步留下的较大一半做双调归并
+    const int C = 2 * VEC_LANES;
+    if (na >= C && nb >= C) {
+        vec_t a0 = vload(a), a1 = vload(a + VEC_LANES);
+        vec_t b0 = vload(b), b1 = vload(b + VEC_LANES);
+        int i = C, j = C, k = 0;
+        merge_2x2(a0, a1, b0, b1);
+        vstore(out, a0);
+        vstore(out + VEC_LANES, a1);
+        k += C;
+        while (i + C <= na && j + C <= nb) {
+            bool take_a = a[i] <= b[j];
+            const int64_t* src = take_a ? a + i : b + j;
+            i += take_a ? C : 0;
+            j += take_a ? 0 : C;
+            a0 = vload(src);
+            a1 = vload(src + VEC_LANES);
+            merge_2x2(a0, a1, b0, b1);
+            vstore(out + k, a0);
+            vstore(out + k + VEC_LANES, a1);
+            k += C;
+        }
+
+        // 尾部：寄存器中剩下的 C 个键先与不足 C 个的一侧合并，再与另一侧剩余部分合并
+        int64_t carry[2 * VEC_LANES];
+        int64_t tail[4 * VEC_LANES];
+        vstore(carry, b0);
+        vstore(carry + VEC_LANES, b1);
+        if (na - i < C) {
+            merge_scalar(carry, C, a + i, na - i, tail);
+            merge_scalar(tail, C + (na - i), b + j, nb - j, out + k);
+        } else {
+            merge_scalar(carry, C, b + j, nb - j, tail);
+            merge_scalar(a + i, na - i, tail, C + (nb - j), out + k);
+        }
+        return;
+    }
+#endif
+    merge_scalar(a, na, b, nb, out);
+}
+
+// 自底向上归并：从宽度 width 的有序段开始，在 keys 与 temp 之间来回归并，结果保证落在 keys 中
+static void merge_passes(int64_t* keys, int64_t* temp, int len, int width) {
+    int64_t* src = keys;
+    int64_t* dst = temp;
+    for (; width < len; width *= 2) {
+        for (int l = 0; l < len; l += 2 * width) {
+            int m = std::min(l + width, len);
+            int r = std::min(l + 2 * width, len);
+            if (m < r) merge_keys(src + l, m - l, src + m, r - m, dst + l);
+            else std::copy(src + l, src + r, dst + l);
+        }
+        std::swap(src, dst);
+    }
+    if (src != keys) std::copy(src, src + len, keys);
+}
+
+// 先以 L2 大小的段为单位完成排序，段内的多轮归并都在缓存中进行
+static const int CACHE_SEGMENT = 65536; // 64K 个键 = 512KB
+
+static void sort_segment(int64_t* keys, int64_t* temp, int len) {
+    int s = 0;
+    for (; s + BLOCK <= len; s += BLOCK) sort_block(keys + s);
+    if (s < len) {
+        // 不足一块时用最大值补齐，排序后只取回前面的有效部分
+        int64_t pad[BLOCK];
+        int m = len - s;
+        std::copy(keys + s, keys + len, pad);
+        std::fill(pad + m, pad + BLOCK, INT64_MAX);
+        sort_block(pad);
+        std::copy(pad, pad + m, keys + s);
+    }
+    merge_passes(keys, temp, len, BLOCK);
+}
+
+void sort_keys(int64_t* keys, int64_t* temp, int len) {
+    if (len <= 1) return;
+    for (int s = 0; s < len; s += CACHE_SEGMENT) {
+        sort_segment(keys + s, temp + s, std::min(CACHE_SEGMENT, len - s));
+    }
+    if (len > CACHE_SEGMENT) merge_passes(keys, temp, len, CACHE_SEGMENT);
+}
+
+// 找到归并结果前 k 个元素中来自 a 的个数（相等时 a 优先，与 merge_scalar 一致）
+static int co_rank(int k, const float* a, int na, const float* b, int nb) {
+    int lo = std::max(0, k - nb);
+    int hi = std::min(k, na);
+    while (lo < hi) {
+        int i = lo + (hi - lo) / 2;
+        int j = k - i;
+        if (make_sort_key(a[i]) <= make_sort_key(b[j - 1])) lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+void merge_by_transform(const float* a, int na, const float* b, int nb, float* out) {
+    const int CHUNK = 65536;
+    std::vector<int64_t> ka(CHUNK), kb(CHUNK), ko(CHUNK);
+    int total = na + nb;
+    int i0 = 0, j0 = 0;
+    for (int k0 = 0; k0 < total; k0 += CHUNK) {
+        int k1 = std::min(total, k0 + CHUNK);
+        int i1 = co_rank(k1, a, na, b, nb);
+        int j1 = k1 - i1;
+        // 每个元素的 transform 只计算一次
+        for (int i = i0; i < i1; ++i) ka[i - i0] = make_sort_key(a[i]);
+        for (int j = j0; j < j1; ++j) kb[j - j0] = make_sort_key(b[j]);
+        merge_keys(ka.data(), i1 - i0, kb.data(), j1 - j0, ko.data());
+        for (int k = k0; k < k1; ++k) out[k] = sort_key_value(ko[k - k0]);
+        i0 = i1;
+        j0 = j1;
+    }
+}
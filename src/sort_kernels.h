@@ -0,0 +1,49 @@
+#ifndef SORT_KERNELS_H
+#define SORT_KERNELS_H
+
+#include <cstdint>
+#include <cstring>
+#include "algorithm.h"
+
+// === 排序内核层 ===
+// 排序只比较 transform() 的结果。为避免在每次比较时重复计算 log/sqrt，先把每个元素
+// 预先打包成 64 位排序键：高 32 位为 transform(v) 的保序整数编码，低 32 位为 v 本身的保序编码。
+// 于是按有符号 int64 比较即等价于按 (transform(v), v) 字典序比较，排序完成后可从低 32 位无损还原 v。
+//
+// 内核分三部分（SSE4.2 下每寄存器 2 个键，开启 AVX2 时 4 个键）：
+// 1. 寄存器内排序网络：一次对 4 个寄存器内的小块做列排序 + 转置 + 双调归并
+// 2. 双调归并网络：归并两个有序段时每次在寄存器内归并 2 个寄存器宽度的数据
+// 3. 无分支标量归并：处理段尾与不足一个寄存器宽度的部分，比较结果用条件传送代替分支
+
+// 打包排序键
+inline int64_t make_sort_key(float v) {
+    float k = transform(v);
+    int32_t kb;
+    uint32_t vb;
+    std::memcpy(&kb, &k, sizeof(kb));
+    std::memcpy(&vb, &v, sizeof(vb));
+    kb ^= (kb >> 31) & 0x7FFFFFFF;                 // float 顺序 -> 有符号整数顺序
+    vb ^= (vb >> 31) ? 0xFFFFFFFFu : 0x80000000u;   // float 顺序 -> 无符号整数顺序
+    return (int64_t)(((uint64_t)(uint32_t)kb << 32) | vb);
+}
+
+// 从排序键还原原始值
+inline float sort_key_value(int64_t key) {
+    uint32_t vb = (uint32_t)key;
+    vb ^= (vb >> 31) ? 0x80000000u : 0xFFFFFFFFu;
+    float v;
+    std::memcpy(&v, &vb, sizeof(v));
+    return v;
+}
+
+// 对 keys[0, len) 原地升序排序，temp 为等长的工作缓冲
+void sort_keys(int64_t* keys, int64_t* temp, int len);
+
+// 归并两个有序键序列到 out（out 不能与输入重叠）
+void merge_keys(const int64_t* a, int na, const int64_t* b, int nb, int64_t* out);
+
+// 按 transform() 顺序归并两个已排序的 float 数组（用于 Master 的最终归并）
+// 分块进行：每块先用二分定位两侧的切分点，再就地生成小块排序键并用向量内核归并，额外内存与 len 无关
+void merge_by_transform(const float* a, int na, const float* b, int nb, float* out);
+
+#endif
@@ -0,0 +1,276 @@
+#include "trace.h"
+#include "algorithm.h"
+#include "network.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+
+std::atomic<bool> g_trace_enabled(false);
+
+// 每个线程最多缓存的 span 数，超出后丢弃并计数
+static const uint32_t SPANS_PER_THREAD = 16384;
+
+// 时钟握手轮数，取往返时间最短的一轮估计偏移
+static const int CLOCK_SYNC_ROUNDS = 16;
+
+struct SpanRecord {
+    const char* name;
+    int64_t start_ns;
+    int64_t dur_ns;
+    int64_t arg;
+};
+
+// 线程私有缓冲：只有所属线程写入，count 用 release 发布，导出方用 acquire 读取
+struct ThreadBuffer {
+    uint32_t tid;
+    std::atomic<uint32_t> count;
+    uint64_t dropped;
+    SpanRecord spans[SPANS_PER_THREAD];
+};
+
+// 缓冲在线程首次记录时注册（只在此时加锁），生命周期到进程结束，OpenMP 线程池退出后也可安全导出
+static std::mutex g_registry_mtx;
+static std::vector<ThreadBuffer*> g_buffers;
+static thread_local ThreadBuffer* t_buffer = nullptr;
+
+static ThreadBuffer* local_buffer() {
+    if (!t_buffer) {
+        ThreadBuffer* buf = new ThreadBuffer();
+        buf->count.store(0, std::memory_order_relaxed);
+        buf->dropped = 0;
+        std::lock_guard<std::mutex> lock(g_registry_mtx);
+        buf->tid = (uint32_t)g_buffers.size();
+        g_buffers.push_back(buf);
+        t_buffer = buf;
+    }
+    return t_buffer;
+}
+
+void trace_record(const char* name, int64_t start_ns, int64_t end_ns, int64_t arg) {
+    if (!g_trace_enabled.load(std::memory_order_relaxed)) return;
+    ThreadBuffer* buf = local_buffer();
+    uint32_t n = buf->count.load(std::memory_order_relaxed);
+    if (n >= SPANS_PER_THREAD) {
+        ++buf->dropped;
+        return;
+    }
+    SpanRecord& r = buf->spans[n];
+    r.name = name;
+    r.start_ns = start_ns;
+    r.dur_ns = end_ns - start_ns;
+    r.arg = arg;
+    buf->count.store(n + 1, std::memory_order_release);
+}
+
+// 导出时使用的扁平事件（名字转为字符串，可跨进程传输）
+struct TraceEvent {
+    int pid;
+    uint32_t tid;
+    std::string name;
+    int64_t start_ns;
+    int64_t dur_ns;
+    int64_t arg;
+};
+
+// 取出并清空本地所有线程缓冲；调用时各工作线程应已空闲
+static std::vector<TraceEvent> drain_local(int pid, uint64_t* dropped) {
+    std::vector<TraceEvent> events;
+    std::lock_guard<std::mutex> lock(g_registry_mtx);
+    for (ThreadBuffer* buf : g_buffers) {
+        uint32_t n = buf->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < n; ++i) {
+            const SpanRecord& r = buf->spans[i];
+            events.push_back(TraceEvent{pid, buf->tid, r.name, r.start_ns, r.dur_ns, r.arg});
+        }
+        *dropped += buf->dropped;
+        buf->count.store(0, std::memory_order_relaxed);
+        buf->dropped = 0;
+    }
+    return events;
+}
+
+template <typename T>
+static void put(std::vector<char>& out, const T& v) {
+    const char* p = reinterpret_cast<const char*>(&v);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+static T get(const std::vector<char>& in, size_t& pos) {
+    T v;
+    if (pos + sizeof(T) > in.size()) {
+        std::cerr << "[Trace] truncated span dump from worker" << std::endl;
+        exit(1);
+    }
+    std::memcpy(&v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+}
+
+// Worker 侧
+
+void trace_serve_clock_sync(int fd) {
+    local_buffer(); // 让命令循环所在的主线程占用 tid 0
+    g_trace_enabled.store(true, std::memory_order_relaxed);
+    std::vector<char> reply;
+    put<int64_t>(reply, trace_now_ns());
+    send_blob(fd, reply);
+}
+
+void trace_serve_dump(int fd) {
+    uint64_t dropped = 0;
+    std::vector<TraceEvent> events = drain_local(1, &dropped);
+    // 二进制格式（假定两端同构，与 send_data 一致）：事件数、丢弃数，随后逐条 start/dur/arg/tid/名字
+    std::vector<char> out;
+    put<uint32_t>(out, (uint32_t)events.size());
+    put<uint64_t>(out, dropped);
+    for (const TraceEvent& e : events) {
+        put<int64_t>(out, e.start_ns);
+        put<int64_t>(out, e.dur_ns);
+        put<int64_t>(out, e.arg);
+        put<uint32_t>(out, e.tid);
+        put<uint16_t>(out, (uint16_t)e.name.size());
+        out.insert(out.end(), e.name.begin(), e.name.end());
+    }
+    send_blob(fd, out);
+    std::cout << "[Trace] sent " << events.size() << " spans to master (" << dropped << " dropped)" << std::endl;
+}
+
+// Master 侧
+
+// 一次时钟握手的结果：master_ns 时刻（往返中点，Master 时钟）测得的偏移
+struct ClockSample {
+    int64_t master_ns;
+    int64_t offset;
+};
+
+// NTP 式估计：offset = worker 时间 - 往返中点的 master 时间，取往返最短的一轮
+static ClockSample clock_sync(int fd, int64_t* best_rtt) {
+    ClockSample sample = {0, 0};
+    *best_rtt = INT64_MAX;
+    for (int i = 0; i < CLOCK_SYNC_ROUNDS; ++i) {
+        int64_t t0 = trace_now_ns();
+        send_cmd(fd, CMD_CLOCK_SYNC);
+        std::vector<char> reply = recv_blob(fd);
+        int64_t t1 = trace_now_ns();
+        size_t pos = 0;
+        int64_t tw = get<int64_t>(reply, pos);
+        if (t1 - t0 < *best_rtt) {
+            *best_rtt = t1 - t0;
+            sample.master_ns = t0 + (t1 - t0) / 2;
+            sample.offset = tw - sample.master_ns;
+        }
+    }
+    return sample;
+}
+
+// 把 Worker 时间戳换算到 Master 时钟：偏移在首尾两次握手之间按时间线性插值，
+// 这样运行期间的漂移落在哪个时刻就扣除哪个时刻的偏移
+static int64_t to_master_ns(int64_t worker_ns, const ClockSample& a, const ClockSample& b) {
+    int64_t t = worker_ns - a.offset; // 先用起始偏移粗略定位该时间戳在 Master 时钟上的位置
+    if (b.master_ns == a.master_ns) return t;
+    double frac = (double)(t - a.master_ns) / (double)(b.master_ns - a.master_ns);
+    return worker_ns - (a.offset + (int64_t)(frac * (double)(b.offset - a.offset)));
+}
+
+static ClockSample g_sync_start = {0, 0};
+
+void trace_start_session(int fd) {
+    local_buffer();
+    g_trace_enabled.store(true, std::memory_order_relaxed);
+    int64_t rtt;
+    g_sync_start = clock_sync(fd, &rtt);
+    std::cout << "[Trace] clock offset " << g_sync_start.offset / 1000.0 << " us (rtt " << rtt / 1000.0 << " us)" << std::endl;
+}
+
+static void write_json_string(std::ofstream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if ((unsigned char)c < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+void trace_finish_session(int fd, const std::string& path) {
+    // 结束时再握手一次，每个 Worker 时间戳按自身时刻在首尾两次偏移之间线性插值，抵消运行期间的时钟漂移
+    int64_t rtt;
+    ClockSample sync_end = clock_sync(fd, &rtt);
+    std::cout << "[Trace] clock drift over run " << (sync_end.offset - g_sync_start.offset) / 1000.0 << " us" << std::endl;
+
+    g_trace_enabled.store(false, std::memory_order_relaxed);
+    uint64_t dropped = 0;
+    std::vector<TraceEvent> events = drain_local(0, &dropped);
+
+    send_cmd(fd, CMD_TRACE_DUMP);
+    std::vector<char> blob = recv_blob(fd);
+    size_t pos = 0;
+    uint32_t n = get<uint32_t>(blob, pos);
+    uint64_t worker_dropped = get<uint64_t>(blob, pos);
+    for (uint32_t i = 0; i < n; ++i) {
+        TraceEvent e;
+        e.pid = 1;
+        int64_t start = get<int64_t>(blob, pos);
+        int64_t end = start + get<int64_t>(blob, pos);
+        // 起止两端分别换算到 Master 时钟
+        e.start_ns = to_master_ns(start, g_sync_start, sync_end);
+        e.dur_ns = to_master_ns(end, g_sync_start, sync_end) - e.start_ns;
+        e.arg = get<int64_t>(blob, pos);
+        e.tid = get<uint32_t>(blob, pos);
+        uint16_t len = get<uint16_t>(blob, pos);
+        if (pos + len > blob.size()) {
+            std::cerr << "[Trace] truncated span dump from worker" << std::endl;
+            exit(1);
+        }
+        e.name.assign(blob.data() + pos, len);
+        pos += len;
+        events.push_back(e);
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[Trace] cannot open " << path << " for writing" << std::endl;
+        return;
+    }
+
+    // 时间戳以最早的 span 为零点，单位微秒
+    int64_t base = INT64_MAX;
+    uint32_t max_tid[2] = {0, 0};
+    for (const TraceEvent& e : events) {
+        base = std::min(base, e.start_ns);
+        max_tid[e.pid] = std::max(max_tid[e.pid], e.tid);
+    }
+    if (events.empty()) base = 0;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    const char* process_names[2] = {"master", "worker"};
+    bool first = true;
+    for (int pid = 0; pid < 2; ++pid) {
+        out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid
+            << ",\"tid\":0,\"args\":{\"name\":\"" << process_names[pid] << "\"}}";
+        first = false;
+        for (uint32_t tid = 0; tid <= max_tid[pid]; ++tid) {
+            std::string thread_name = tid == 0 ? "main" : "thread " + std::to_string(tid);
+            out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << thread_name << "\"}}";
+        }
+    }
+    for (const TraceEvent& e : events) {
+        out << ",\n{\"ph\":\"X\",\"name\":";
+        write_json_string(out, e.name);
+        out << ",\"pid\":" << e.pid << ",\"tid\":" << e.tid
+            << ",\"ts\":" << (e.start_ns - base) / 1000.0 << ",\"dur\":" << e.dur_ns / 1000.0;
+        if (e.arg >= 0) out << ",\"args\":{\"n\":" << e.arg << "}";
+        out << "}";
+    }
+    out << "\n]}\n";
+
+    std::cout << "[Trace] wrote " << events.size() << " spans to " << path
+              << " (dropped: master " << dropped << ", worker " << worker_dropped << ")" << std::endl;
+}
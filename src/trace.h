@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <ctime>
+
+// === 跨节点时间线追踪 ===
+// 每个线程拥有自己的 span 缓冲（单写者，记录时无锁），未开启时每个埋点只多一次 relaxed 原子读。
+// Master 开启追踪时先与 Worker 做时钟偏移握手（同时让 Worker 开始记录），运行结束后拉取 Worker 的 span，
+// 换算到 Master 时钟后与本地 span 一起写成 Chrome trace event 格式的 JSON，可直接用 chrome://tracing 或 Perfetto 打开。
+
+extern std::atomic<bool> g_trace_enabled;
+
+// 追踪用时钟（CLOCK_MONOTONIC，纳秒）
+inline int64_t trace_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 把已有的 CLOCK_MONOTONIC 计时点换算成追踪时钟
+inline int64_t trace_ns(const struct timespec& ts) {
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 记录一个完整区间；name 必须是静态字符串，arg < 0 表示没有附加参数
+void trace_record(const char* name, int64_t start_ns, int64_t end_ns, int64_t arg = -1);
+
+// RAII 区间：构造时记下起点，析构时写入当前线程的缓冲
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, int64_t arg = -1)
+        : name_(name), arg_(arg), start_(g_trace_enabled.load(std::memory_order_relaxed) ? trace_now_ns() : 0) {}
+    ~TraceSpan() {
+        if (start_) trace_record(name_, start_, trace_now_ns(), arg_);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    int64_t arg_;
+    int64_t start_;
+};
+
+// === Worker 侧命令处理 ===
+// CMD_CLOCK_SYNC：开启本地记录并回复当前时间戳
+void trace_serve_clock_sync(int fd);
+// CMD_TRACE_DUMP：发送本地全部 span 后清空缓冲
+void trace_serve_dump(int fd);
+
+// === Master 侧 ===
+// 开启本地记录，并与 Worker 做时钟偏移握手
+void trace_start_session(int fd);
+// 再次握手，拉取 Worker 的 span，与本地 span 合并写出 trace.json
+void trace_finish_session(int fd, const std::string& path);
+
+#endif
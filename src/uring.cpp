@@ -0,0 +1,167 @@
+#include "uring.h"
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// 系统调用包装（glibc 未提供）
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags, const void* arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+// 内核与用户态共享的环形指针需要 acquire/release 语义
+static inline unsigned load_acquire(const unsigned* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(unsigned* p, unsigned v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+IoRing::~IoRing() {
+    if (sqes_) munmap(sqes_, sqes_sz_);
+    if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_map_sz_);
+    if (sq_ptr_) munmap(sq_ptr_, sq_map_sz_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+// 老内核上 io_uring_setup 成功但操作码不存在，要到第一个 CQE 才以 -EINVAL 暴露，这里提前探测
+static bool probe_ops(int fd, const std::vector<uint8_t>& ops) {
+    const unsigned nr = 256;
+    std::vector<char> buf(sizeof(struct io_uring_probe) + nr * sizeof(struct io_uring_probe_op), 0);
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(buf.data());
+    if (sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, nr) < 0) return false;
+    for (uint8_t op : ops) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+    }
+    return true;
+}
+
+bool IoRing::init(unsigned entries, const std::vector<uint8_t>& required_ops) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0) return false;
+
+    // 没有 EXT_ARG 就无法给等待加超时，socket 卡死时会无限阻塞；所需操作码缺失时同样视为不可用
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !probe_ops(fd, required_ops)) {
+        close(fd);
+        errno = EOPNOTSUPP;
+        return false;
+    }
+
+    features_ = p.features;
+    sq_map_sz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_map_sz_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    // 新内核 SQ/CQ 共用一次 mmap
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_map_sz_ > sq_map_sz_) sq_map_sz_ = cq_map_sz_;
+        cq_map_sz_ = sq_map_sz_;
+    }
+
+    sq_ptr_ = mmap(nullptr, sq_map_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+        sq_ptr_ = nullptr;
+        close(fd);
+        return false;
+    }
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr_ = sq_ptr_;
+    } else {
+        cq_ptr_ = mmap(nullptr, cq_map_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) {
+            cq_ptr_ = nullptr;
+            munmap(sq_ptr_, sq_map_sz_);
+            sq_ptr_ = nullptr;
+            close(fd);
+            return false;
+        }
+    }
+
+    sqes_sz_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_map_sz_);
+        munmap(sq_ptr_, sq_map_sz_);
+        sq_ptr_ = cq_ptr_ = nullptr;
+        close(fd);
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_entries_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sqe_tail_ = *sq_tail_;
+
+    char* cq = static_cast<char*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    ring_fd_ = fd;
+    return true;
+}
+
+struct io_uring_sqe* IoRing::get_sqe() {
+    unsigned head = load_acquire(sq_head_);
+    if (sqe_tail_ - head >= *sq_entries_) return nullptr;
+    unsigned idx = sqe_tail_ & *sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[idx] = idx;
+    ++sqe_tail_;
+    ++to_submit_;
+    return sqe;
+}
+
+int IoRing::submit_and_wait(unsigned wait_nr, int timeout_ms) {
+    store_release(sq_tail_, sqe_tail_);
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    const void* arg = nullptr;
+    size_t argsz = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg ext;
+    // init 已保证 EXT_ARG 可用：在 enter 中直接携带超时，避免 socket 卡死时无限阻塞
+    if (wait_nr > 0 && timeout_ms > 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL;
+        memset(&ext, 0, sizeof(ext));
+        ext.ts = (unsigned long long)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        arg = &ext;
+        argsz = sizeof(ext);
+    }
+
+    int ret = sys_io_uring_enter(ring_fd_, to_submit_, wait_nr, flags, arg, argsz);
+    if (ret < 0) return -errno;
+    to_submit_ -= (unsigned)ret < to_submit_ ? (unsigned)ret : to_submit_;
+    return ret;
+}
+
+bool IoRing::peek_cqe(struct io_uring_cqe** cqe) {
+    unsigned head = *cq_head_;
+    if (head == load_acquire(cq_tail_)) return false;
+    *cqe = &cqes_[head & *cq_mask_];
+    return true;
+}
+
+void IoRing::cqe_seen() {
+    store_release(cq_head_, *cq_head_ + 1);
+}
@@ -0,0 +1,61 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// === 极简 io_uring 封装 ===
+// 直接基于 io_uring_setup/io_uring_enter/io_uring_register 系统调用，不依赖 liburing
+// 只提供条带传输所需的最小功能：取 SQE、提交并等待、遍历 CQE
+class IoRing {
+public:
+    IoRing() = default;
+    ~IoRing();
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // 创建 ring 并映射 SQ/CQ；内核不支持或被禁用时返回 false（errno 指明原因），调用方应回退到 poll()
+    // 能建 ring 不代表能用：还要求内核支持 IORING_FEAT_EXT_ARG（submit_and_wait 的超时依赖它，5.11+），
+    // 且 required_ops 中的每个操作码都能通过 IORING_REGISTER_PROBE 探测到（如 SEND/RECV 需 5.6+）
+    bool init(unsigned entries, const std::vector<uint8_t>& required_ops);
+    bool ok() const { return ring_fd_ >= 0; }
+
+    // 取一个空闲 SQE（已清零）；队列满时返回 nullptr
+    struct io_uring_sqe* get_sqe();
+
+    // 提交所有已填写的 SQE，并至少等待 wait_nr 个完成事件
+    // timeout_ms > 0 时最多等待该时长，超时返回 -ETIME；其他错误返回 -errno
+    int submit_and_wait(unsigned wait_nr, int timeout_ms);
+
+    // 查看一个完成事件，没有则返回 false；处理完后必须调用 cqe_seen()
+    bool peek_cqe(struct io_uring_cqe** cqe);
+    void cqe_seen();
+
+private:
+    int ring_fd_ = -1;
+    unsigned features_ = 0;
+
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_map_sz_ = 0;
+    size_t cq_map_sz_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_sz_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_entries_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sqe_tail_ = 0;    // 本地已填写但尚未发布给内核的尾指针
+    unsigned to_submit_ = 0;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    struct io_uring_cqe* cqes_ = nullptr;
+};
+
+#endif